@@ -17,6 +17,7 @@ void print_file_system_info(const char *disk) {
 
     // unmapping the disk
     munmap(d.start, d.size);
+    free(d.extents);
 }
 
 void list_root_directory(const char *diskPath) {
@@ -39,6 +40,47 @@ void list_root_directory(const char *diskPath) {
     free(entries.entries);
     // unmapping the disk
     munmap(d.start, d.size);
+    free(d.extents);
+}
+
+void report_deleted_entries(const char *diskPath) {
+    struct Disk d = readDisk(diskPath);
+    BootEntry *boot = (BootEntry *)d.start;
+    struct FAT fat = readFAT(d, boot);
+
+    unsigned int rootCluster = boot->BPB_RootClus;
+    unsigned int clusterCount = MIN(dataClusterCount(boot), (unsigned int) fat.fatLength);
+    unsigned char *freeBitmap = freeClusterBitmap(fat, clusterCount);
+
+    struct AllEntries entries = getEntries(d, boot, rootCluster);
+    int deletedFiles = 0;
+    for (int i = 0; i < entries.numEntries; i++) {
+        DirEntry *entry = &entries.entries[i];
+        if (entry->DIR_Name[0] != 0xE5 || entry->DIR_Attr == 0x0F || (entry->DIR_Attr | 0x10) == entry->DIR_Attr)
+            continue;
+
+        // the first character of a deleted name is lost
+        char *filename = getFilename(entry);
+        filename[0] = '?';
+        printf("%s (size = %d", filename, entry->DIR_FileSize);
+        free(filename);
+
+        struct Recoverability r = assessEntry(d, boot, freeBitmap, clusterCount, entry);
+        if (entry->DIR_FileSize != 0) {
+            printf(", starting cluster = %d", entry->DIR_FstClusHI << 16 | entry->DIR_FstClusLO);
+            printf(", free = %d/%d, zero = %d, reallocated = %d", r.freeClusters, r.totalClusters, r.zeroClusters, r.reallocatedClusters);
+        }
+        printf(") score = %d, method = %s\n", r.score, r.method);
+        deletedFiles++;
+    }
+
+    printf("Total number of deleted entries = %d\n", deletedFiles);
+
+    free(entries.entries);
+    free(freeBitmap);
+    // unmapping the disk
+    munmap(d.start, d.size);
+    free(d.extents);
 }
 
 void recover_contiguous_file(const char *diskPath, const char *filename, const char *sha1) {
@@ -78,6 +120,7 @@ void recover_contiguous_file(const char *diskPath, const char *filename, const c
 
     // unmapping the disk
     munmap(d.start, d.size);
+    free(d.extents);
 
     printf("%s: successfully recovered", filename);
     if (strlen(sha1) > 0) {
@@ -86,7 +129,7 @@ void recover_contiguous_file(const char *diskPath, const char *filename, const c
     printf("\n");
 }
 
-void recover_non_contiguous_file(const char *diskPath, const char *filename, char *sha1) {
+void recover_non_contiguous_file(const char *diskPath, const char *filename, char *sha1, const char *checkpointPath) {
     struct Disk d = readDisk(diskPath);
     BootEntry *boot = (BootEntry *)d.start;
     struct FAT fat = readFAT(d, boot);
@@ -94,7 +137,7 @@ void recover_non_contiguous_file(const char *diskPath, const char *filename, cha
     if (strcmp(sha1, "da39a3ee5e6b4b0d3255bfef95601890afd80709") == 0 || strlen(sha1) == 0) {
         *fileToRecover = getRecoveryFileEntryContiguous(d, boot, fat, filename, sha1);
     } else {
-        *fileToRecover = getRecoveryFileEntryNonContiguous(d, boot, fat, filename, sha1);
+        *fileToRecover = getRecoveryFileEntryNonContiguous(d, boot, fat, filename, sha1, checkpointPath);
     }
 
     // Fix the directory entry
@@ -106,6 +149,7 @@ void recover_non_contiguous_file(const char *diskPath, const char *filename, cha
 
     // unmapping the disk
     munmap(d.start, d.size);
+    free(d.extents);
 
     printf("%s: successfully recovered", filename);
     if (strlen(sha1) > 0) {
@@ -3,7 +3,8 @@
 
 void print_file_system_info(const char *disk);
 void list_root_directory(const char *diskPath);
+void report_deleted_entries(const char *diskPath);
 void recover_contiguous_file(const char *diskPath, const char *filename, const char *sha1);
-void recover_non_contiguous_file(const char *diskPath, const char *filename, char *sha1);
+void recover_non_contiguous_file(const char *diskPath, const char *filename, char *sha1, const char *checkpointPath);
 
 #endif
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include "helper.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -6,9 +7,56 @@
 #include <sys/mman.h>
 #include <unistd.h>
 #include "common.h"
+#include "search.h"
 #include <string.h>
+#include <errno.h>
 #include <openssl/sha.h>
 
+static void appendExtent(struct Disk *d, int *capacity, unsigned long long offset, unsigned long long length) {
+    if (d->numExtents == *capacity) {
+        *capacity *= 2;
+        d->extents = realloc(d->extents, *capacity * sizeof(struct Extent));
+        if (d->extents == NULL) {
+            fprintf(stderr, "Error: malloc failed \n");
+            exit(1);
+        }
+    }
+    d->extents[d->numExtents].offset = offset;
+    d->extents[d->numExtents].length = length;
+    d->numExtents++;
+}
+
+static void readExtents(int fd, struct Disk *d) {
+    int capacity = 16;
+    d->numExtents = 0;
+    d->extents = malloc(capacity * sizeof(struct Extent));
+    if (d->extents == NULL) {
+        fprintf(stderr, "Error: malloc failed \n");
+        exit(1);
+    }
+
+    off_t position = 0;
+    while (position < d->size) {
+        off_t dataStart = lseek(fd, position, SEEK_DATA);
+        if (dataStart < 0 && errno == ENXIO) {
+            // only a hole remains
+            break;
+        }
+        if (dataStart < 0) {
+            // holes can't be found on this file, so treat all of it as data
+            d->numExtents = 0;
+            appendExtent(d, &capacity, 0, d->size);
+            return;
+        }
+        off_t holeStart = lseek(fd, dataStart, SEEK_HOLE);
+        if (holeStart < 0 || holeStart > d->size) {
+            holeStart = d->size;
+        }
+        appendExtent(d, &capacity, dataStart, holeStart - dataStart);
+        position = holeStart;
+    }
+}
+
 struct Disk readDisk(const char *disk) {
     struct Disk d;
     struct stat st;
@@ -24,10 +72,40 @@ struct Disk readDisk(const char *disk) {
         fprintf(stderr, "Error: mmap failed \n");
         exit(1);
     }
+    readExtents(fd, &d);
     close(fd);
     return d;
 }
 
+bool isHole(struct Disk disk, const char *address, unsigned long long length) {
+    unsigned long long offset = address - disk.start;
+    unsigned long long end = offset + length;
+
+    // Find the last extent starting before the end of the range
+    int low = 0;
+    int high = disk.numExtents - 1;
+    int last = -1;
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
+        if (disk.extents[mid].offset < end) {
+            last = mid;
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    if (last < 0) {
+        return true;
+    }
+    return disk.extents[last].offset + disk.extents[last].length <= offset;
+}
+
+bool clusterIsHole(struct Disk disk, const struct BootEntry *boot, unsigned int cluster) {
+    unsigned int bytesInCluster = bytesPerCluster(boot);
+    char *clusterAddress = (cluster - 2) * bytesInCluster + firstClusterStart(disk, boot);
+    return isHole(disk, clusterAddress, bytesInCluster);
+}
+
 struct FAT readFAT(struct Disk disk, const struct BootEntry *boot) {
     struct FAT fat;
 
@@ -57,6 +135,73 @@ unsigned int bytesPerCluster(const struct BootEntry *boot) {
     return sectorPerCluster * bytesPerSector;
 }
 
+unsigned int dataClusterCount(const struct BootEntry *boot) {
+    unsigned int totalSectors = boot->BPB_TotSec32 != 0 ? boot->BPB_TotSec32 : boot->BPB_TotSec16;
+    unsigned int dataSectors = totalSectors - boot->BPB_RsvdSecCnt - boot->BPB_NumFATs * boot->BPB_FATSz32;
+    return dataSectors / boot->BPB_SecPerClus + 2;
+}
+
+unsigned char *freeClusterBitmap(const struct FAT fat, unsigned int clusterCount) {
+    unsigned char *bitmap = calloc(clusterCount / 8 + 1, 1);
+    if (bitmap == NULL) {
+        fprintf(stderr, "Error: malloc failed \n");
+        exit(1);
+    }
+    for (unsigned int c = 2; c < clusterCount; c++) {
+        // the top four bits of a FAT32 entry are reserved
+        if ((fat.fatsStart[c] & 0x0FFFFFFF) == 0) {
+            bitmap[c / 8] |= 1 << (c % 8);
+        }
+    }
+    return bitmap;
+}
+
+struct Recoverability assessEntry(struct Disk disk, const struct BootEntry *boot, const unsigned char *freeBitmap, unsigned int clusterCount, const DirEntry *entry) {
+    struct Recoverability r = {0, 0, 0, 0, 100, "contiguous"};
+    if (entry->DIR_FileSize == 0) {
+        return r;
+    }
+
+    unsigned int startCluster = entry->DIR_FstClusHI << 16 | entry->DIR_FstClusLO;
+    unsigned int bytesInCluster = bytesPerCluster(boot);
+    r.totalClusters = entry->DIR_FileSize / bytesInCluster + (entry->DIR_FileSize % bytesInCluster != 0);
+
+    bool startIntact = false;
+    for (int i = 0; i < r.totalClusters; i++) {
+        unsigned int cluster = startCluster + i;
+        if (cluster < 2 || cluster >= clusterCount) {
+            continue;
+        }
+        if (!(freeBitmap[cluster / 8] & (1 << (cluster % 8)))) {
+            r.reallocatedClusters++;
+        } else {
+            r.freeClusters++;
+            startIntact = startIntact || i == 0;
+            // holes read back as zeros, which is valid content for a sparse copy
+            if (clusterIsHole(disk, boot, cluster)) {
+                r.zeroClusters++;
+            }
+        }
+    }
+
+    // A hole may be a discarded block rather than real zeros, so it doesn't count as intact
+    r.score = (r.freeClusters - r.zeroClusters) * 100 / r.totalClusters;
+    if (r.freeClusters > 0 && r.zeroClusters == r.freeClusters) {
+        r.method = "zeroed";
+    } else if (r.freeClusters == r.totalClusters) {
+        r.method = "contiguous";
+    } else if (startIntact && startCluster >= SEARCH_RANGE_START && startCluster <= SEARCH_RANGE_END
+               && r.totalClusters <= SEARCH_RANGE_END - SEARCH_RANGE_START + 1) {
+        r.method = "search needed";
+    } else if (startIntact) {
+        // -R only looks for the rest of the chain among its candidate clusters
+        r.method = "not searchable";
+    } else {
+        r.method = "lost";
+    }
+    return r;
+}
+
 char *getFilename(const DirEntry *entry) {
     int size = 11;
     char *filename = malloc(size + 2);
@@ -147,7 +292,12 @@ struct FileContents fileContents(struct Disk disk, const struct BootEntry *boot,
     while (contentsIndex < fileSize) {
         char *clusterAddress = (currentCluster - 2) * bytesInCluster + firstClusterAddress;
         unsigned int bytesToRead = MIN(bytesInCluster, fileSize - contentsIndex);
-        memcpy(contents + contentsIndex, clusterAddress, bytesToRead);
+        if (isHole(disk, clusterAddress, bytesToRead)) {
+            // don't fault in pages that are known to be zero
+            memset(contents + contentsIndex, 0, bytesToRead);
+        } else {
+            memcpy(contents + contentsIndex, clusterAddress, bytesToRead);
+        }
         contentsIndex += bytesToRead;
         currentCluster = fat[currentCluster];
     }
@@ -173,7 +323,12 @@ struct FileContents fileContentsContiguous(struct Disk disk, const struct BootEn
     while (contentsIndex < fileSize) {
         char *clusterAddress = (currentCluster - 2) * bytesInCluster + firstClusterAddress;
         unsigned int bytesToRead = MIN(bytesInCluster, fileSize - contentsIndex);
-        memcpy(contents + contentsIndex, clusterAddress, bytesToRead);
+        if (isHole(disk, clusterAddress, bytesToRead)) {
+            // don't fault in pages that are known to be zero
+            memset(contents + contentsIndex, 0, bytesToRead);
+        } else {
+            memcpy(contents + contentsIndex, clusterAddress, bytesToRead);
+        }
         contentsIndex += bytesToRead;
         currentCluster = currentCluster + 1;
     }
@@ -266,119 +421,90 @@ bool isCorrectFAT(struct Disk disk, const struct BootEntry *boot, const struct D
     return matches;
 }
 
-int GLOBAL_rangeStart = -1;
-int GLOBAL_rangeEnd = -1;
-int GLOBAL_startCluster = -1;
-int *GLOBAL_fat = NULL;
-int *GLOBAL_correct_fat = NULL;
-int GLOBAL_fatLength = 0;
-struct Disk GLOBAL_disk;
-struct BootEntry GLOBAL_boot;
-struct DirEntry GLOBAL_entry;
-char *GLOBAL_sha1;
-
-int recursion(int *lastArr, int length, int targetLength) {
-    if (length == targetLength) {
-        // Modify the FAT
-        int *copyFat = malloc(GLOBAL_fatLength * sizeof(int));
-        memcpy(copyFat, GLOBAL_fat, GLOBAL_fatLength * sizeof(int));
-        for (int i = 0; i < length - 1; i++) {
-            copyFat[lastArr[i]] = lastArr[i + 1];
-        }
-        copyFat[lastArr[length - 1]] = EOFat;
-
-        // for (int i = 0; i < length; i++) {
-        //     printf("%d ", lastArr[i]);
-        // }
-        // printf("\n");
-
-        // Check if the FAT is correct
-        if (isCorrectFAT(GLOBAL_disk, &GLOBAL_boot, &GLOBAL_entry, copyFat, GLOBAL_sha1)) {
-            // printf("Found a correct FAT!\n");
-            GLOBAL_correct_fat = copyFat;
-            return 1;
-        } else {
-            free(copyFat);
-            return 0;
-        }
-    } else {
-        // recursive case
-        bool flag = false;
-        for (int i = GLOBAL_rangeStart; i <= GLOBAL_rangeEnd; i++) {
-            flag = false;
-            for (int j = 0; j < length; j++) {
-                if (i == lastArr[j]) {
-                    flag = true;
-                    break;
-                }
-            }
-            if (!flag) {
-                lastArr[length] = i;
-                int result = recursion(lastArr, length + 1, targetLength);
-                if (result == 1) {
-                    return 1;
-                }
-            }
-        }
-        return 0;
-    }
-}
-
-int isCorrectEntry(struct Disk disk, const struct BootEntry *boot, const struct DirEntry *entry, char *sha1) {
+int *isCorrectEntry(struct Disk disk, const struct BootEntry *boot, const struct DirEntry *entry, const char *sha1, struct SearchFrontier *frontier, const struct Checkpoint *checkpoint) {
     if (entry->DIR_FileSize == 0) {
-        return 0;
+        return NULL;
     }
 
     struct FAT fat = readFAT(disk, boot);
-    int startCluster = entry->DIR_FstClusHI << 16 | entry->DIR_FstClusLO;
-    unsigned int bytesInCluster = bytesPerCluster(boot);
-    int numberOfClusters = entry->DIR_FileSize / bytesInCluster + (entry->DIR_FileSize % bytesInCluster != 0);
-    // int endCluster = startCluster + 21;
-
-    GLOBAL_boot = *boot;
-    GLOBAL_disk = disk;
-    GLOBAL_entry = *entry;
-    GLOBAL_fat = fat.fatsStart;
-    GLOBAL_fatLength = fat.fatLength;
-    GLOBAL_startCluster = startCluster;
-    GLOBAL_sha1 = sha1;
-    GLOBAL_rangeStart = 2;
-    GLOBAL_rangeEnd = 22;
-
-    int *lastArr = malloc(numberOfClusters * sizeof(int));
-    lastArr[0] = startCluster;
-    int result = recursion(lastArr, 1, numberOfClusters);
-    free(lastArr);
-    return result;
+    return searchChain(disk, boot, entry, fat, sha1, frontier, checkpoint);
 }
 
-struct FileToRecover getRecoveryFileEntryNonContiguous(struct Disk disk, const struct BootEntry *boot, const struct FAT fat, const char *filename, char *sha1) {
+static bool isDeletedFileNamed(const DirEntry *entry, const char *filename) {
+    if (entry->DIR_Name[0] != 0xE5 || (entry->DIR_Attr | 0x10) == entry->DIR_Attr) {
+        return false;
+    }
+    char *name = getFilename(entry);
+    bool matches = strcmp(name + 1, filename + 1) == 0;
+    free(name);
+    return matches;
+}
+
+struct FileToRecover getRecoveryFileEntryNonContiguous(struct Disk disk, const struct BootEntry *boot, const struct FAT fat, const char *filename, char *sha1, const char *checkpointPath) {
     unsigned int rootCluster = boot->BPB_RootClus;
+    unsigned int bytesInCluster = bytesPerCluster(boot);
     struct AllEntries entries = getEntries(disk, boot, rootCluster);
     DirEntry *fileToRecover = NULL;
     int fileToRecoverIndex = -1;
-    for (int i = 0; i < entries.numEntries; i++){
+
+    struct Checkpoint checkpoint = {checkpointPath, sha1, filename, boot->BS_VolID, disk.size, fat.fatLength};
+    struct Checkpoint *checkpointOrNull = checkpointPath != NULL ? &checkpoint : NULL;
+    struct SearchFrontier saved;
+    enum CheckpointStatus status = checkpointPath != NULL ? loadCheckpoint(&checkpoint, &saved) : CHECKPOINT_MISSING;
+    if (status == CHECKPOINT_FOREIGN) {
+        // Never overwrite or remove a file that isn't our checkpoint
+        fprintf(stderr, "Remove %s or choose another checkpoint path\n", checkpointPath);
+        exit(1);
+    }
+    bool resuming = status == CHECKPOINT_LOADED;
+    if (resuming) {
+        // Only trust the saved position if it still names the same directory entry
+        DirEntry *entry = saved.entryIndex < entries.numEntries ? &entries.entries[saved.entryIndex] : NULL;
+        if (entry == NULL || !isDeletedFileNamed(entry, filename)
+            || saved.startCluster != (entry->DIR_FstClusHI << 16 | entry->DIR_FstClusLO)
+            || saved.targetLength != (int) (entry->DIR_FileSize / bytesInCluster + (entry->DIR_FileSize % bytesInCluster != 0))) {
+            fprintf(stderr, "Warning: checkpoint %s does not match the directory entry, starting over\n", checkpointPath);
+            freeFrontier(&saved);
+            resuming = false;
+        }
+    }
+
+    // Entries before a saved frontier were already searched without a match
+    for (int i = resuming ? saved.entryIndex : 0; i < entries.numEntries; i++){
         DirEntry *entry = &entries.entries[i];
-        if (entry->DIR_Name[0] == 0xE5 && (entry->DIR_Attr | 0x10) != entry->DIR_Attr) {
-            char *name = getFilename(entry);
-            if (strcmp(name + 1, filename + 1) == 0) {
-                if (isCorrectEntry(disk, boot, entry, sha1)) {
-                    fileToRecoverIndex = i;
-                    fileToRecover = entry;
-                    // Modify the FAT
-                    int (*fatsArray)[fat.fatLength] = (void *)fat.fatsStart;
-                    for (int k = 0; k < GLOBAL_fatLength; k++) {
-                        for (int x = 0; x < fat.numFats; x++) {
-                            fatsArray[x][k] = GLOBAL_correct_fat[k];
-                        }
-                    }
-                    free(GLOBAL_correct_fat);
-                    break;
+        // an empty file has no chain to search
+        if (!isDeletedFileNamed(entry, filename) || entry->DIR_FileSize == 0) {
+            continue;
+        }
+        int startCluster = entry->DIR_FstClusHI << 16 | entry->DIR_FstClusLO;
+        int numberOfClusters = entry->DIR_FileSize / bytesInCluster + (entry->DIR_FileSize % bytesInCluster != 0);
+        struct SearchFrontier frontier;
+        if (resuming) {
+            frontier = saved;
+            resuming = false;
+            fprintf(stderr, "Resuming search at %.2f%% from %s\n", searchProgress(&frontier) * 100, checkpointPath);
+        } else if (!initFrontier(&frontier, i, startCluster, numberOfClusters)) {
+            continue;
+        }
+        int *correctFat = isCorrectEntry(disk, boot, entry, sha1, &frontier, checkpointOrNull);
+        freeFrontier(&frontier);
+        if (correctFat != NULL) {
+            fileToRecoverIndex = i;
+            fileToRecover = entry;
+            // Modify the FAT
+            int (*fatsArray)[fat.fatLength] = (void *)fat.fatsStart;
+            for (int k = 0; k < fat.fatLength; k++) {
+                for (int x = 0; x < fat.numFats; x++) {
+                    fatsArray[x][k] = correctFat[k];
                 }
             }
-            free(name);
+            free(correctFat);
+            break;
         }
     }
+    if (checkpointPath != NULL) {
+        remove(checkpointPath);
+    }
     if (!fileToRecover) {
         fprintf(stderr, "%s: file not found\n", filename);
         exit(1);
@@ -3,9 +3,16 @@
 #include "fat32_struct.h"
 #include <stdbool.h>
 
+struct Extent {
+    unsigned long long offset; // byte offset of the extent in the image
+    unsigned long long length; // length of the extent in bytes
+};
+
 struct Disk {
     char *start;
     int size;
+    int numExtents; // number of data extents, holes lie between them
+    struct Extent *extents; // data extents sorted by offset
 };
 
 struct FAT {
@@ -24,15 +31,29 @@ struct FileContents {
     unsigned char *contents;
 };
 
+struct Recoverability {
+    int totalClusters; // clusters the file would occupy if stored contiguously
+    int freeClusters; // of those, clusters still free in the FAT
+    int zeroClusters; // of the free clusters, those that lie in a hole and read as zeros
+    int reallocatedClusters; // of those, clusters now used by another file
+    int score; // percentage of clusters that are still free and not in a hole
+    const char *method; // recommended recovery method
+};
+
 struct FileToRecover {
     DirEntry *entry;
     char *startAddress;
 };
 
 struct Disk readDisk(const char *disk); // read the disk into memory
+bool isHole(struct Disk disk, const char *address, unsigned long long length); // check if a range of the disk lies entirely in a hole
+bool clusterIsHole(struct Disk disk, const struct BootEntry *boot, unsigned int cluster); // check if a cluster lies entirely in a hole
 struct FAT readFAT(struct Disk disk, const struct BootEntry *boot); // read the FAT into memory
 char *firstClusterStart(struct Disk disk, const struct BootEntry *boot); // get the first cluster of a file
 unsigned int bytesPerCluster(const struct BootEntry *boot); // get the size of a single cluster in bytes
+unsigned int dataClusterCount(const struct BootEntry *boot); // get the number of clusters in the data region, plus the two reserved entries
+unsigned char *freeClusterBitmap(const struct FAT fat, unsigned int clusterCount); // build a bitmap with one bit set per free cluster
+struct Recoverability assessEntry(struct Disk disk, const struct BootEntry *boot, const unsigned char *freeBitmap, unsigned int clusterCount, const DirEntry *entry); // estimate how much of a deleted file is still intact
 char *getFilename(const DirEntry *entry); // get the filename of a directory entry
 void printFilename(const DirEntry *entry); // print the filename of a directory entry
 int clusterChainLength(unsigned int cluster, const struct FAT *fat); // get the length of a cluster chain
@@ -43,6 +64,6 @@ bool sha1Matches(const char *sha1, const struct FileContents contents); // check
 char *getDirEntryAddress(struct Disk disk, const struct BootEntry *boot, const struct FAT fat, unsigned int startCluster, unsigned int entryIndex); // get the address of a directory entry
 struct FileToRecover getRecoveryFileEntryContiguous(struct Disk disk, const struct BootEntry *boot, const struct FAT fat, const char *filename, const char *sha1); // get the directory entry of a file to recover
 bool isCorrectFAT(struct Disk disk, const struct BootEntry *boot, const struct DirEntry *entry, const int *fat, const char *sha1); // check if a file is the one we are looking for
-struct FileToRecover getRecoveryFileEntryNonContiguous(struct Disk disk, const struct BootEntry *boot, const struct FAT fat, const char *filename, char *sha1); // get the directory entry of a file to recover that is not stored contiguously
+struct FileToRecover getRecoveryFileEntryNonContiguous(struct Disk disk, const struct BootEntry *boot, const struct FAT fat, const char *filename, char *sha1, const char *checkpointPath); // get the directory entry of a file to recover that is not stored contiguously, resuming from checkpointPath if given
 
 #endif
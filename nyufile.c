@@ -11,8 +11,10 @@
 // Usage: ./nyufile disk <options>
 //   -i                     Print the file system information.
 //   -l                     List the root directory.
+//   -L                     Report how recoverable each deleted file is.
 //   -r filename [-s sha1]  Recover a contiguous file.
 //   -R filename -s sha1    Recover a possibly non-contiguous file.
+//     [-c checkpoint]      Save search progress to, and resume from, checkpoint.
 
 int main(int argc, char *argv[]) {
     int opt;
@@ -22,8 +24,10 @@ int main(int argc, char *argv[]) {
     bool isContiguous = false;
     bool printFSInfo = false;
     bool listRootDir = false;
+    bool reportDeleted = false;
+    char *checkpointPath = NULL;
 
-    while ((opt = getopt(argc, argv, "ilr:R:s:")) != -1) {
+    while ((opt = getopt(argc, argv, "ilLr:R:s:c:")) != -1) {
         switch (opt) {
         case 'i':
             printFSInfo = true;
@@ -31,6 +35,9 @@ int main(int argc, char *argv[]) {
         case 'l':
             listRootDir = true;
             break;
+        case 'L':
+            reportDeleted = true;
+            break;
         case 'r':
             isFileRecovery = true;
             isContiguous = true;
@@ -47,12 +54,17 @@ int main(int argc, char *argv[]) {
         case 's':
             strncpy(sha1, optarg, 41);
             break;
+        case 'c':
+            checkpointPath = optarg;
+            break;
         default:
             fprintf(stderr, "Usage: %s disk <options>\n", argv[0]);
             fprintf(stderr, "  -i                     Print the file system information.\n"
                             "  -l                     List the root directory.\n"
+                            "  -L                     Report how recoverable each deleted file is.\n"
                             "  -r filename [-s sha1]  Recover a contiguous file.\n"
-                            "  -R filename -s sha1    Recover a possibly non-contiguous file.\n");
+                            "  -R filename -s sha1    Recover a possibly non-contiguous file.\n"
+                            "    [-c checkpoint]      Save search progress to, and resume from, checkpoint.\n");
             return 1;
         }
     }
@@ -62,8 +74,10 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "Usage: %s disk <options>\n", argv[0]);
         fprintf(stderr, "  -i                     Print the file system information.\n"
                         "  -l                     List the root directory.\n"
+                        "  -L                     Report how recoverable each deleted file is.\n"
                         "  -r filename [-s sha1]  Recover a contiguous file.\n"
-                        "  -R filename -s sha1    Recover a possibly non-contiguous file.\n");
+                        "  -R filename -s sha1    Recover a possibly non-contiguous file.\n"
+                        "    [-c checkpoint]      Save search progress to, and resume from, checkpoint.\n");
         return 1;
     }
 
@@ -73,18 +87,23 @@ int main(int argc, char *argv[]) {
     } else if (listRootDir) {
         list_root_directory(disk);
         return 0;
+    } else if (reportDeleted) {
+        report_deleted_entries(disk);
+        return 0;
     } else if (isFileRecovery) {
         if (isContiguous) {
             recover_contiguous_file(disk, filename, sha1);
         } else {
-            recover_non_contiguous_file(disk, filename, sha1);
+            recover_non_contiguous_file(disk, filename, sha1, checkpointPath);
         }
     } else {
         fprintf(stderr, "Usage: %s disk <options>\n", argv[0]);
         fprintf(stderr, "  -i                     Print the file system information.\n"
                         "  -l                     List the root directory.\n"
+                        "  -L                     Report how recoverable each deleted file is.\n"
                         "  -r filename [-s sha1]  Recover a contiguous file.\n"
-                        "  -R filename -s sha1    Recover a possibly non-contiguous file.\n");
+                        "  -R filename -s sha1    Recover a possibly non-contiguous file.\n"
+                        "    [-c checkpoint]      Save search progress to, and resume from, checkpoint.\n");
         return 1;
     }
 
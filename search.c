@@ -0,0 +1,342 @@
+#include "search.h"
+#include "common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define CHECKPOINT_MAGIC "nyufile-checkpoint 1"
+
+static volatile sig_atomic_t pendingSignal = 0;
+
+static void onSignal(int sig) {
+    pendingSignal = sig;
+}
+
+static bool inChain(const int *chain, int length, int cluster) {
+    for (int j = 0; j < length; j++) {
+        if (chain[j] == cluster) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool initFrontier(struct SearchFrontier *frontier, int entryIndex, int startCluster, int targetLength) {
+    if (targetLength < 1) {
+        frontier->chain = NULL;
+        frontier->next = NULL;
+        return false;
+    }
+    frontier->entryIndex = entryIndex;
+    frontier->startCluster = startCluster;
+    frontier->targetLength = targetLength;
+    frontier->rangeStart = SEARCH_RANGE_START;
+    frontier->rangeEnd = SEARCH_RANGE_END;
+    frontier->chain = calloc(targetLength + 1, sizeof(int));
+    frontier->next = calloc(targetLength + 1, sizeof(int));
+    if (frontier->chain == NULL || frontier->next == NULL) {
+        fprintf(stderr, "Error: malloc failed \n");
+        exit(1);
+    }
+    frontier->chain[0] = startCluster;
+    frontier->next[1] = frontier->rangeStart;
+    frontier->depth = 1;
+    frontier->tested = 0;
+    return true;
+}
+
+void freeFrontier(struct SearchFrontier *frontier) {
+    free(frontier->chain);
+    free(frontier->next);
+    frontier->chain = NULL;
+    frontier->next = NULL;
+}
+
+static bool validFrontier(const struct SearchFrontier *frontier, int fatLength) {
+    if (frontier->rangeStart != SEARCH_RANGE_START || frontier->rangeEnd != SEARCH_RANGE_END) {
+        return false;
+    }
+    if (frontier->entryIndex < 0 || frontier->startCluster < 2 || frontier->startCluster >= fatLength) {
+        return false;
+    }
+    for (int d = 1; d < frontier->depth; d++) {
+        int cluster = frontier->chain[d];
+        if (cluster < frontier->rangeStart || cluster > frontier->rangeEnd || cluster >= fatLength || inChain(frontier->chain, d, cluster)) {
+            return false;
+        }
+    }
+    for (int d = 1; d <= frontier->depth; d++) {
+        if (frontier->next[d] < frontier->rangeStart || frontier->next[d] > frontier->rangeEnd + 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+enum CheckpointStatus loadCheckpoint(const struct Checkpoint *checkpoint, struct SearchFrontier *frontier) {
+    FILE *f = fopen(checkpoint->path, "r");
+    if (f == NULL && errno == ENOENT) {
+        return CHECKPOINT_MISSING;
+    }
+    if (f == NULL) {
+        fprintf(stderr, "Error: cannot read checkpoint %s\n", checkpoint->path);
+        return CHECKPOINT_FOREIGN;
+    }
+
+    char magic[32] = {0};
+    char savedSha1[SHA_DIGEST_LENGTH + 1] = {0};
+    char savedFilename[13] = {0};
+    unsigned int volumeId;
+    int imageSize;
+    bool ok = fgets(magic, sizeof(magic), f) != NULL
+        && strncmp(magic, CHECKPOINT_MAGIC, strlen(CHECKPOINT_MAGIC)) == 0
+        && fscanf(f, " sha1 %40s", savedSha1) == 1
+        && fscanf(f, " filename %12s", savedFilename) == 1
+        && fscanf(f, " volume %u", &volumeId) == 1
+        && fscanf(f, " size %d", &imageSize) == 1;
+    if (!ok) {
+        fclose(f);
+        fprintf(stderr, "Error: %s is not a checkpoint file\n", checkpoint->path);
+        return CHECKPOINT_FOREIGN;
+    }
+    if (strcmp(savedSha1, strlen(checkpoint->sha1) > 0 ? checkpoint->sha1 : "-") != 0
+        || strcmp(savedFilename, checkpoint->filename) != 0
+        || volumeId != checkpoint->volumeId || imageSize != checkpoint->imageSize) {
+        fclose(f);
+        fprintf(stderr, "Error: checkpoint %s was saved for a different file or disk\n", checkpoint->path);
+        return CHECKPOINT_FOREIGN;
+    }
+
+    int entryIndex, startCluster, targetLength, rangeStart, rangeEnd, depth;
+    unsigned long long tested;
+    ok = fscanf(f, " entry %d", &entryIndex) == 1
+        && fscanf(f, " start %d", &startCluster) == 1
+        && fscanf(f, " length %d", &targetLength) == 1
+        && fscanf(f, " range %d %d", &rangeStart, &rangeEnd) == 2
+        && fscanf(f, " tested %llu", &tested) == 1
+        && fscanf(f, " depth %d", &depth) == 1
+        && targetLength > 0 && targetLength <= checkpoint->fatLength && depth >= 1 && depth <= targetLength;
+
+    ok = ok && initFrontier(frontier, entryIndex, startCluster, targetLength);
+    if (ok) {
+        frontier->rangeStart = rangeStart;
+        frontier->rangeEnd = rangeEnd;
+        frontier->depth = depth;
+        frontier->tested = tested;
+        ok = fscanf(f, " chain") == 0;
+        for (int d = 0; ok && d < depth; d++) {
+            ok = fscanf(f, "%d", &frontier->chain[d]) == 1;
+        }
+        ok = ok && fscanf(f, " next") == 0;
+        for (int d = 0; ok && d <= depth; d++) {
+            ok = fscanf(f, "%d", &frontier->next[d]) == 1;
+        }
+        ok = ok && frontier->chain[0] == startCluster && validFrontier(frontier, checkpoint->fatLength);
+        if (!ok) {
+            freeFrontier(frontier);
+        }
+    }
+    fclose(f);
+
+    if (!ok) {
+        fprintf(stderr, "Warning: ignoring malformed or out-of-range search state in %s, starting over\n", checkpoint->path);
+        return CHECKPOINT_STALE;
+    }
+    return CHECKPOINT_LOADED;
+}
+
+bool saveCheckpoint(const struct Checkpoint *checkpoint, const struct SearchFrontier *frontier) {
+    const char *path = checkpoint->path;
+    size_t tmpLength = strlen(path) + 8;
+    char *tmpPath = malloc(tmpLength);
+    if (tmpPath == NULL) {
+        fprintf(stderr, "Error: malloc failed \n");
+        exit(1);
+    }
+    snprintf(tmpPath, tmpLength, "%s.XXXXXX", path);
+
+    // A fresh temporary name so no existing file is ever overwritten
+    int fd = mkstemp(tmpPath);
+    FILE *f = fd < 0 ? NULL : fdopen(fd, "w");
+    if (f == NULL) {
+        fprintf(stderr, "Warning: could not write checkpoint %s\n", path);
+        if (fd >= 0) {
+            close(fd);
+            remove(tmpPath);
+        }
+        free(tmpPath);
+        return false;
+    }
+    fprintf(f, "%s\n", CHECKPOINT_MAGIC);
+    fprintf(f, "sha1 %s\n", strlen(checkpoint->sha1) > 0 ? checkpoint->sha1 : "-");
+    fprintf(f, "filename %s\n", checkpoint->filename);
+    fprintf(f, "volume %u\n", checkpoint->volumeId);
+    fprintf(f, "size %d\n", checkpoint->imageSize);
+    fprintf(f, "entry %d\n", frontier->entryIndex);
+    fprintf(f, "start %d\n", frontier->startCluster);
+    fprintf(f, "length %d\n", frontier->targetLength);
+    fprintf(f, "range %d %d\n", frontier->rangeStart, frontier->rangeEnd);
+    fprintf(f, "tested %llu\n", frontier->tested);
+    fprintf(f, "depth %d\n", frontier->depth);
+    fprintf(f, "chain");
+    for (int d = 0; d < frontier->depth; d++) {
+        fprintf(f, " %d", frontier->chain[d]);
+    }
+    fprintf(f, "\nnext");
+    for (int d = 0; d <= frontier->depth; d++) {
+        fprintf(f, " %d", frontier->next[d]);
+    }
+    fprintf(f, "\n");
+
+    // Only replace the previous checkpoint once the new one is complete
+    bool ok = fclose(f) == 0 && rename(tmpPath, path) == 0;
+    if (!ok) {
+        fprintf(stderr, "Warning: could not write checkpoint %s\n", path);
+        remove(tmpPath);
+    }
+    free(tmpPath);
+    return ok;
+}
+
+double searchProgress(const struct SearchFrontier *frontier) {
+    // Candidates available at level 1; each deeper level has one fewer
+    int pool = 0;
+    for (int c = frontier->rangeStart; c <= frontier->rangeEnd; c++) {
+        if (c != frontier->chain[0]) {
+            pool++;
+        }
+    }
+
+    // Sum the share of every subtree ranked before the current path
+    double progress = 0.0;
+    double weight = 1.0;
+    int lastLevel = MIN(frontier->depth, frontier->targetLength - 1);
+    for (int d = 1; d <= lastLevel; d++) {
+        int available = pool - (d - 1);
+        if (available <= 0) {
+            break;
+        }
+        weight /= available;
+        int bound = d < frontier->depth ? frontier->chain[d] : frontier->next[d];
+        int before = 0;
+        for (int c = frontier->rangeStart; c < bound && c <= frontier->rangeEnd; c++) {
+            if (!inChain(frontier->chain, d, c)) {
+                before++;
+            }
+        }
+        progress += before * weight;
+    }
+    return MIN(progress, 1.0);
+}
+
+static bool redundantHole(const struct SearchFrontier *frontier, const bool *holes, int depth, int cluster) {
+    // Every hole reads back as zeros, so only the lowest unused one is worth trying
+    if (!holes[cluster - frontier->rangeStart]) {
+        return false;
+    }
+    for (int c = frontier->rangeStart; c < cluster; c++) {
+        if (holes[c - frontier->rangeStart] && !inChain(frontier->chain, depth, c)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int *searchChain(struct Disk disk, const struct BootEntry *boot, const DirEntry *entry, const struct FAT fat, const char *sha1, struct SearchFrontier *frontier, const struct Checkpoint *checkpoint) {
+    int *copyFat = malloc(fat.fatLength * sizeof(int));
+    if (copyFat == NULL) {
+        fprintf(stderr, "Error: malloc failed \n");
+        exit(1);
+    }
+
+    bool *holes = malloc((frontier->rangeEnd - frontier->rangeStart + 1) * sizeof(bool));
+    if (holes == NULL) {
+        fprintf(stderr, "Error: malloc failed \n");
+        exit(1);
+    }
+    for (int c = frontier->rangeStart; c <= frontier->rangeEnd; c++) {
+        holes[c - frontier->rangeStart] = clusterIsHole(disk, boot, c);
+    }
+
+    struct sigaction action, oldInt, oldTerm;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &oldInt);
+    sigaction(SIGTERM, &action, &oldTerm);
+    pendingSignal = 0;
+
+    time_t lastCheckpoint = time(NULL);
+    time_t lastProgress = lastCheckpoint;
+    unsigned long long steps = 0;
+    bool found = false;
+
+    int *chain = frontier->chain;
+    int *next = frontier->next;
+    while (frontier->depth >= 1) {
+        if (pendingSignal) {
+            if (checkpoint != NULL && saveCheckpoint(checkpoint, frontier)) {
+                fprintf(stderr, "Interrupted at %.2f%% of the search space; progress saved to %s\n", searchProgress(frontier) * 100, checkpoint->path);
+            } else {
+                fprintf(stderr, "Interrupted at %.2f%% of the search space\n", searchProgress(frontier) * 100);
+            }
+            exit(128 + pendingSignal);
+        }
+        if (++steps % 4096 == 0) {
+            time_t now = time(NULL);
+            if (checkpoint != NULL && now - lastCheckpoint >= CHECKPOINT_INTERVAL) {
+                saveCheckpoint(checkpoint, frontier);
+                lastCheckpoint = now;
+            }
+            if (now - lastProgress >= PROGRESS_INTERVAL) {
+                fprintf(stderr, "Searched %.2f%% (%llu chains)\n", searchProgress(frontier) * 100, frontier->tested);
+                lastProgress = now;
+            }
+        }
+
+        int depth = frontier->depth;
+        if (depth == frontier->targetLength) {
+            // Complete chain: link it into a scratch FAT and check the contents
+            memcpy(copyFat, fat.fatsStart, fat.fatLength * sizeof(int));
+            for (int i = 0; i < depth - 1; i++) {
+                copyFat[chain[i]] = chain[i + 1];
+            }
+            copyFat[chain[depth - 1]] = EOFat;
+            frontier->tested++;
+            if (isCorrectFAT(disk, boot, entry, copyFat, sha1)) {
+                found = true;
+                break;
+            }
+            frontier->depth--;
+            continue;
+        }
+
+        // Advance to the next cluster not already in the chain
+        int candidate = next[depth];
+        while (candidate <= frontier->rangeEnd && (inChain(chain, depth, candidate) || redundantHole(frontier, holes, depth, candidate))) {
+            candidate++;
+        }
+        if (candidate > frontier->rangeEnd) {
+            frontier->depth--;
+            continue;
+        }
+        chain[depth] = candidate;
+        next[depth] = candidate + 1;
+        frontier->depth++;
+        next[frontier->depth] = frontier->rangeStart;
+    }
+
+    sigaction(SIGINT, &oldInt, NULL);
+    sigaction(SIGTERM, &oldTerm, NULL);
+    free(holes);
+
+    if (!found) {
+        free(copyFat);
+        return NULL;
+    }
+    return copyFat;
+}
@@ -0,0 +1,46 @@
+#ifndef NYUFILE_SEARCH_H
+#define NYUFILE_SEARCH_H
+#include "helper.h"
+#include <stdbool.h>
+
+#define SEARCH_RANGE_START 2 // first cluster considered when searching for a chain
+#define SEARCH_RANGE_END 22 // last cluster considered when searching for a chain
+#define CHECKPOINT_INTERVAL 30 // seconds between checkpoint writes
+#define PROGRESS_INTERVAL 5 // seconds between progress reports
+
+struct SearchFrontier {
+    int entryIndex; // index of the directory entry being searched
+    int startCluster; // first cluster of the file, always chain[0]
+    int targetLength; // number of clusters in a complete chain
+    int rangeStart; // first candidate cluster
+    int rangeEnd; // last candidate cluster
+    int depth; // number of clusters currently fixed in the chain
+    int *chain; // chain[0..depth-1] is the current partial chain
+    int *next; // next[d] is the next candidate cluster to try at level d
+    unsigned long long tested; // number of complete chains checked so far
+};
+
+struct Checkpoint {
+    const char *path; // file the frontier is saved to
+    const char *sha1; // SHA-1 of the file being searched for
+    const char *filename; // name of the file being searched for
+    unsigned int volumeId; // BS_VolID of the disk being searched
+    int imageSize; // size of the disk image in bytes
+    int fatLength; // number of entries in one FAT
+};
+
+enum CheckpointStatus {
+    CHECKPOINT_MISSING, // nothing exists at the checkpoint path yet
+    CHECKPOINT_LOADED, // the saved frontier was restored
+    CHECKPOINT_STALE, // a checkpoint for this search whose frontier can't be used
+    CHECKPOINT_FOREIGN // the path holds something else and must be left alone
+};
+
+bool initFrontier(struct SearchFrontier *frontier, int entryIndex, int startCluster, int targetLength); // set up a search from the first candidate, false if the chain is empty
+void freeFrontier(struct SearchFrontier *frontier); // release the chain and successor arrays
+enum CheckpointStatus loadCheckpoint(const struct Checkpoint *checkpoint, struct SearchFrontier *frontier); // restore a frontier saved for the same search if it is within bounds
+bool saveCheckpoint(const struct Checkpoint *checkpoint, const struct SearchFrontier *frontier); // atomically write the frontier to the checkpoint path
+double searchProgress(const struct SearchFrontier *frontier); // fraction of the search space already covered
+int *searchChain(struct Disk disk, const struct BootEntry *boot, const DirEntry *entry, const struct FAT fat, const char *sha1, struct SearchFrontier *frontier, const struct Checkpoint *checkpoint); // search for a FAT whose chain matches sha1
+
+#endif